@@ -3,17 +3,24 @@
 #include <sstream>
 #include <unordered_map>
 #include <unordered_set>
+#include <map>
 #include <memory>
 #include <ctime>
 #include <iomanip>
 #include <fstream>
+#include <filesystem>
 #include <queue>
+#include <deque>
+#include <atomic>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <vector>
 #include <chrono>
 #include <random>
+#include <functional>
+#include <algorithm>
+#include <cctype>
 
 using namespace std;
 
@@ -27,7 +34,7 @@ uint64_t clampUint32Range(uint64_t value) {
 }
 
 uint64_t clampDelayPerExec(uint64_t value) {
-    return min(value, 4294967296ULL);
+    return min<uint64_t>(value, 4294967296ULL);
 }
 
 uint16_t clampUint16(int value) {
@@ -43,12 +50,34 @@ struct SystemConfig {
     uint64_t minInstructions = 0;
     uint64_t maxInstructions = 0;
     uint64_t delayPerExec = 0;
+    uint64_t logEntries = 100;           // optional: executed lines each process keeps for process-smi
+    bool logSpill = false;               // optional: write lines evicted from that log to process-logs/
+    bool lockstep = false;               // optional: cores advance on a shared tick barrier
+    uint64_t lockstepTickUs = 1000;      // optional: shortest real duration of a lockstep tick, 0 = unpaced
 };
 
 // Declare the global instance
 SystemConfig GLOBAL_CONFIG;
 
-bool loadSystemConfig(const string& filename = "config.txt") {
+// Guards GLOBAL_CONFIG once threads are running; bumped version tells workers to refresh their copy
+mutex configMutex;
+atomic<uint64_t> configVersion{ 0 };
+
+SystemConfig configSnapshot() {
+    lock_guard<mutex> lock(configMutex);
+    return GLOBAL_CONFIG;
+}
+
+// Re-copies GLOBAL_CONFIG only if reconfigure changed it since the last look
+bool refreshConfig(SystemConfig& config, uint64_t& seenVersion) {
+    if (configVersion.load() == seenVersion) return false;
+    lock_guard<mutex> lock(configMutex);
+    config = GLOBAL_CONFIG;
+    seenVersion = configVersion.load();
+    return true;
+}
+
+bool loadSystemConfig(SystemConfig& config, const string& filename = "config.txt") {
     ifstream file(filename);
     if (!file.is_open()) {
         cerr << "Error: Could not open config.txt" << endl;
@@ -64,7 +93,7 @@ bool loadSystemConfig(const string& filename = "config.txt") {
                 cerr << "Invalid num-cpu value. Must be 1–128." << endl;
                 return false;
             }
-            GLOBAL_CONFIG.numCPU = clampCPUs(value);
+            config.numCPU = clampCPUs(value);
         }
         else if (key == "scheduler") {
             string value;
@@ -73,32 +102,60 @@ bool loadSystemConfig(const string& filename = "config.txt") {
                 cerr << "Invalid scheduler. Must be 'fcfs' or 'rr'." << endl;
                 return false;
             }
-            GLOBAL_CONFIG.scheduler = value;
+            config.scheduler = value;
         }
         else if (key == "quantum-cycles") {
             int64_t value;
             file >> value;
-            GLOBAL_CONFIG.quantumCycles = clampUint32Range(value);
+            config.quantumCycles = clampUint32Range(value);
         }
         else if (key == "batch-process-freq") {
             int64_t value;
             file >> value;
-            GLOBAL_CONFIG.batchProcessFreq = clampUint32Range(value);
+            config.batchProcessFreq = clampUint32Range(value);
         }
         else if (key == "min-ins") {
             int64_t value;
             file >> value;
-            GLOBAL_CONFIG.minInstructions = clampUint32Range(value);
+            config.minInstructions = clampUint32Range(value);
         }
         else if (key == "max-ins") {
             int64_t value;
             file >> value;
-            GLOBAL_CONFIG.maxInstructions = clampUint32Range(value);
+            config.maxInstructions = clampUint32Range(value);
         }
         else if (key == "delay-per-exec") {
             uint64_t value;
             file >> value;
-            GLOBAL_CONFIG.delayPerExec = clampDelayPerExec(value);
+            config.delayPerExec = clampDelayPerExec(value);
+        }
+        else if (key == "log-entries") {
+            int64_t value;
+            file >> value;
+            config.logEntries = clampUint32Range(value);
+        }
+        else if (key == "log-spill") {
+            int value;
+            file >> value;
+            if (value != 0 && value != 1) {
+                cerr << "Invalid log-spill value. Must be 0 or 1." << endl;
+                return false;
+            }
+            config.logSpill = value == 1;
+        }
+        else if (key == "lockstep") {
+            int value;
+            file >> value;
+            if (value != 0 && value != 1) {
+                cerr << "Invalid lockstep value. Must be 0 or 1." << endl;
+                return false;
+            }
+            config.lockstep = value == 1;
+        }
+        else if (key == "lockstep-tick-us") {
+            uint64_t value;
+            file >> value;
+            config.lockstepTickUs = clampDelayPerExec(value);
         }
         else {
             cerr << "Unknown config key: " << key << endl;
@@ -107,7 +164,7 @@ bool loadSystemConfig(const string& filename = "config.txt") {
     }
 
     // Final validation
-    if (GLOBAL_CONFIG.minInstructions > GLOBAL_CONFIG.maxInstructions) {
+    if (config.minInstructions > config.maxInstructions) {
         cerr << "min-ins cannot be greater than max-ins." << endl;
         return false;
     }
@@ -133,8 +190,7 @@ void clearScreen() {
     cout << "\033[2J\033[1;1H";
 }
 
-string generateTimestamp() {
-    auto now = time(nullptr);
+string generateTimestamp(time_t now = time(nullptr)) {
     tm localTime;
 #ifdef _WIN32   
     localtime_s(&localTime, &now); // Windows
@@ -147,176 +203,628 @@ string generateTimestamp() {
 }
 
 uint64_t cpuBurstGenerator() {
+    SystemConfig config = configSnapshot();
     std::random_device rd;
     std::mt19937_64 gen(rd()); // use 64-bit generator
-    std::uniform_int_distribution<uint64_t> distrib(GLOBAL_CONFIG.minInstructions, GLOBAL_CONFIG.maxInstructions);
+    std::uniform_int_distribution<uint64_t> distrib(config.minInstructions, config.maxInstructions);
 
     return distrib(gen);
 }
 
 
-vector<string> process_instructions(uint64_t cpuBurst) {
-    vector<string> instructions;
-    unordered_map<string, uint16_t> declaredVars;
-    vector<string> varNames;
+// Process programs are compiled once at creation: the executor only walks resolved ops
+const uint32_t DEFAULT_PROCESS_MEMORY = 1024;   // bytes of emulated memory when screen -s omits a size
+const int MAX_FOR_DEPTH = 3;
+const uint64_t MAX_UNROLLED_OPS = 16;           // loops at most this large after unrolling are flattened
+const uint32_t MAX_GENERATED_VARS = 32;
+const uint64_t MAX_GENERATED_BODY = 32;         // longest random loop body; longer bursts repeat one
+
+enum class OpCode : uint8_t {
+    DECLARE,
+    PRINT,
+    ADD,
+    SUBTRACT,
+    SLEEP,
+    READ,
+    WRITE,
+    FOR_BEGIN,
+    FOR_END
+};
 
-    random_device rd;
-    mt19937 gen(rd());
-    uniform_int_distribution<> cmdDistrib(0, 5);
-    uniform_int_distribution<> valDistrib(1, 100);
+// Either a variable slot or an immediate value, resolved by the compile pass
+struct Operand {
+    bool isVar = false;
+    uint32_t value = 0;
+};
 
-    for (uint64_t i = 0; i < cpuBurst; ++i) {
-        int cmd = cmdDistrib(gen);
-        stringstream ss;
-
-        if (cmd == 1 || varNames.empty()) {
-            // DECLARE
-            string var = "v" + to_string(varNames.size());
-            uint16_t val = valDistrib(gen);
-            declaredVars[var] = val;
-            varNames.push_back(var);
-            ss << "DECLARE " << var << " " << val;
-        }
-        else if (cmd == 0 && !varNames.empty()) {
-            // PRINT
-            string var = varNames[gen() % varNames.size()];
-            ss << "PRINT " << var;
-        }
-        else if (cmd == 2 && varNames.size() >= 2) {
-            // ADD
-            string a = varNames[gen() % varNames.size()];
-            string b = varNames[gen() % varNames.size()];
-            ss << "ADD " << a << " " << b;
-        }
-        else if (cmd == 3 && varNames.size() >= 2) {
-            // SUBTRACT
-            string a = varNames[gen() % varNames.size()];
-            string b = varNames[gen() % varNames.size()];
-            ss << "SUBTRACT " << a << " " << b;
+struct Op {
+    OpCode code = OpCode::DECLARE;
+    uint32_t dst = 0;        // variable slot written by DECLARE/ADD/SUBTRACT/READ, read by PRINT
+    Operand a;               // first source; SLEEP ms, READ/WRITE address, FOR_BEGIN repeat count
+    Operand b;               // second source; WRITE value
+    uint32_t target = 0;     // FOR_BEGIN: index of its FOR_END, FOR_END: index of its FOR_BEGIN
+};
+
+struct Program {
+    vector<Op> ops;
+    vector<string> varNames;     // slot -> name, only used when rendering logs
+    uint64_t totalLines = 0;     // instructions executed by one full run, loops expanded
+    uint32_t memorySize = DEFAULT_PROCESS_MEMORY;
+};
+
+// Validates operands, resolves variable names to slots, folds constant arithmetic and
+// unrolls trivial loops as instructions are appended. Used by both the text parser and
+// the random generator so every program reaches the executor in the same shape.
+class ProgramBuilder {
+private:
+    struct LoopFrame {
+        size_t begin;
+        uint32_t repeats;
+        uint64_t linesBefore;
+    };
+
+    Program program;
+    unordered_map<string, uint32_t> symbols;
+    vector<LoopFrame> loops;
+    string lastError;
+
+    static bool isNumber(const string& token) {
+        return !token.empty() && all_of(token.begin(), token.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); });
+    }
+
+    static bool isIdentifier(const string& token) {
+        if (token.empty() || !(isalpha(static_cast<unsigned char>(token[0])) || token[0] == '_')) return false;
+        return all_of(token.begin(), token.end(), [](char c) { return isalnum(static_cast<unsigned char>(c)) || c == '_'; });
+    }
+
+    bool literal(const string& token, uint64_t maxValue, uint32_t& out) {
+        if (!isNumber(token) || token.size() > 10 || stoull(token) > maxValue) {
+            return fail("'" + token + "' is not a number in 0-" + to_string(maxValue));
         }
-        else if (cmd == 4) {
-            // SLEEP
-            ss << "SLEEP 100";
+        out = static_cast<uint32_t>(stoull(token));
+        return true;
+    }
+
+    bool variable(const string& token, uint32_t& slot) {
+        if (!isIdentifier(token)) return fail("'" + token + "' is not a valid variable name");
+        auto it = symbols.find(token);
+        if (it == symbols.end()) {
+            it = symbols.emplace(token, static_cast<uint32_t>(program.varNames.size())).first;
+            program.varNames.push_back(token);
         }
-        else {
-            // FOR loop
-            if (!varNames.empty()) {
-                string var = varNames[gen() % varNames.size()];
-                ss << "FOR " << var << " 3";
+        slot = it->second;
+        return true;
+    }
+
+    bool operand(const string& token, Operand& out) {
+        out.isVar = !isNumber(token);
+        return out.isVar ? variable(token, out.value) : literal(token, 65535, out.value);
+    }
+
+    // Addresses are hex (0x...) or decimal and must leave room for a 2-byte word
+    bool address(const string& token, Operand& out) {
+        bool hex = token.size() > 2 && token[0] == '0' && (token[1] == 'x' || token[1] == 'X');
+        string digits = hex ? token.substr(2) : token;
+        bool valid = !digits.empty() && digits.size() <= 8 && all_of(digits.begin(), digits.end(), [hex](char c) {
+            return hex ? isxdigit(static_cast<unsigned char>(c)) : isdigit(static_cast<unsigned char>(c));
+            });
+        uint64_t value = valid ? stoull(digits, nullptr, hex ? 16 : 10) : 0;
+        if (!valid || value + 2 > program.memorySize) {
+            return fail("address '" + token + "' is outside the " + to_string(program.memorySize) + "-byte memory");
+        }
+        out.isVar = false;
+        out.value = static_cast<uint32_t>(value);
+        return true;
+    }
+
+    bool emit(const Op& op) {
+        program.ops.push_back(op);
+        program.totalLines++;
+        return true;
+    }
+
+    // Copies body ops to the end of the program, shifting the jump targets of nested loops
+    void appendBody(const vector<Op>& body, size_t oldStart) {
+        size_t newStart = program.ops.size();
+        for (Op op : body) {
+            if (op.code == OpCode::FOR_BEGIN || op.code == OpCode::FOR_END) {
+                op.target = static_cast<uint32_t>(op.target - oldStart + newStart);
             }
-            else {
-                string var = "v" + to_string(varNames.size());
-                uint16_t val = valDistrib(gen);
-                declaredVars[var] = val;
-                varNames.push_back(var);
-                ss << "DECLARE " << var << " " << val;
+            program.ops.push_back(op);
+        }
+    }
+
+public:
+    explicit ProgramBuilder(uint32_t memorySize) {
+        program.memorySize = memorySize;
+    }
+
+    const string& error() const { return lastError; }
+
+    bool fail(const string& message) {
+        lastError = message;
+        return false;
+    }
+
+    bool declare(const string& var, const string& value) {
+        Op op;
+        op.code = OpCode::DECLARE;
+        op.a.isVar = false;
+        return variable(var, op.dst) && literal(value, 65535, op.a.value) && emit(op);
+    }
+
+    bool print(const string& var) {
+        Op op;
+        op.code = OpCode::PRINT;
+        return variable(var, op.dst) && emit(op);
+    }
+
+    bool arithmetic(OpCode code, const string& dst, const string& lhs, const string& rhs) {
+        Op op;
+        op.code = code;
+        if (!variable(dst, op.dst) || !operand(lhs, op.a) || !operand(rhs, op.b)) return false;
+        if (!op.a.isVar && !op.b.isVar) {
+            // Both sides known at compile time: store the result directly
+            int result = (code == OpCode::ADD) ? static_cast<int>(op.a.value + op.b.value)
+                : static_cast<int>(op.a.value) - static_cast<int>(op.b.value);
+            op.code = OpCode::DECLARE;
+            op.a.value = clampUint16(result);
+            op.b = Operand{};
+        }
+        return emit(op);
+    }
+
+    bool sleep(const string& ms) {
+        Op op;
+        op.code = OpCode::SLEEP;
+        return literal(ms, 65535, op.a.value) && emit(op);
+    }
+
+    bool read(const string& var, const string& addr) {
+        Op op;
+        op.code = OpCode::READ;
+        return variable(var, op.dst) && address(addr, op.a) && emit(op);
+    }
+
+    bool write(const string& addr, const string& value) {
+        Op op;
+        op.code = OpCode::WRITE;
+        return address(addr, op.a) && operand(value, op.b) && emit(op);
+    }
+
+    bool beginFor(const string& repeats) {
+        if (static_cast<int>(loops.size()) >= MAX_FOR_DEPTH) {
+            return fail("FOR blocks nest at most " + to_string(MAX_FOR_DEPTH) + " deep");
+        }
+        Op op;
+        op.code = OpCode::FOR_BEGIN;
+        if (!literal(repeats, 65535, op.a.value)) return false;
+        loops.push_back({ program.ops.size(), op.a.value, program.totalLines });
+        program.ops.push_back(op);
+        return true;
+    }
+
+    bool endFor() {
+        if (loops.empty()) return fail("']' without a matching FOR");
+        LoopFrame frame = loops.back();
+        loops.pop_back();
+
+        size_t bodyStart = frame.begin + 1;
+        vector<Op> body(program.ops.begin() + bodyStart, program.ops.end());
+        uint64_t bodyLines = program.totalLines - frame.linesBefore;
+        program.ops.resize(frame.begin);
+
+        if (frame.repeats == 0 || body.empty()) {
+            program.totalLines = frame.linesBefore;
+            return true;
+        }
+        program.totalLines += bodyLines * (frame.repeats - 1);
+
+        bool hasLoop = any_of(body.begin(), body.end(), [](const Op& op) { return op.code == OpCode::FOR_BEGIN; });
+        if (frame.repeats == 1 || (!hasLoop && body.size() * frame.repeats <= MAX_UNROLLED_OPS)) {
+            for (uint32_t i = 0; i < frame.repeats; ++i) {
+                appendBody(body, bodyStart);
             }
+            return true;
         }
 
-        instructions.push_back(ss.str());
+        Op begin;
+        begin.code = OpCode::FOR_BEGIN;
+        begin.a.value = frame.repeats;
+        begin.target = static_cast<uint32_t>(frame.begin + 1 + body.size());
+        program.ops.push_back(begin);
+        appendBody(body, bodyStart);
+
+        Op end;
+        end.code = OpCode::FOR_END;
+        end.target = static_cast<uint32_t>(frame.begin);
+        program.ops.push_back(end);
+        return true;
+    }
+
+    bool finish(Program& out) {
+        if (!loops.empty()) return fail("FOR block is missing its closing ']'");
+        if (program.totalLines == 0) return fail("program has no instructions to run");
+        out = move(program);
+        return true;
     }
-    return instructions;
+};
+
+// Text form, instructions separated by ';':
+//   DECLARE x 5; ADD y x 1; FOR 3 [ PRINT y; WRITE 0x40 y; READ z 0x40 ]; SLEEP 10
+bool parseProgram(const string& source, ProgramBuilder& builder) {
+    string spaced;
+    for (char c : source) {
+        if (c == '[' || c == ']' || c == ';') {
+            spaced += ' ';
+            spaced += c;
+            spaced += ' ';
+        }
+        else {
+            spaced += c;
+        }
+    }
+
+    istringstream iss(spaced);
+    vector<string> tokens;
+    string token;
+    while (iss >> token) tokens.push_back(token);
+
+    size_t i = 0;
+    while (i < tokens.size()) {
+        if (tokens[i] == ";") {
+            ++i;
+            continue;
+        }
+        if (tokens[i] == "]") {
+            if (!builder.endFor()) return false;
+            ++i;
+            continue;
+        }
+
+        string name = tokens[i++];
+        vector<string> args;
+        while (i < tokens.size() && tokens[i] != ";" && tokens[i] != "[" && tokens[i] != "]") {
+            args.push_back(tokens[i++]);
+        }
+
+        bool ok;
+        if (name == "DECLARE" && args.size() == 2) ok = builder.declare(args[0], args[1]);
+        else if (name == "PRINT" && args.size() == 1) ok = builder.print(args[0]);
+        else if (name == "ADD" && args.size() == 3) ok = builder.arithmetic(OpCode::ADD, args[0], args[1], args[2]);
+        else if (name == "SUBTRACT" && args.size() == 3) ok = builder.arithmetic(OpCode::SUBTRACT, args[0], args[1], args[2]);
+        else if (name == "SLEEP" && args.size() == 1) ok = builder.sleep(args[0]);
+        else if (name == "READ" && args.size() == 2) ok = builder.read(args[0], args[1]);
+        else if (name == "WRITE" && args.size() == 2) ok = builder.write(args[0], args[1]);
+        else if (name == "FOR" && args.size() == 1 && i < tokens.size() && tokens[i] == "[") {
+            ok = builder.beginFor(args[0]);
+            ++i;
+        }
+        else ok = builder.fail("cannot parse '" + name + "' with " + to_string(args.size()) + " operand(s)");
+
+        if (!ok) return false;
+    }
+    return true;
 }
 
-void instructions_manager(uint64_t currentLine, vector<string>& instructions, unordered_map<string, uint16_t>& memory, const string& processName, int coreId) {
-    // Ensure instructions has enough space to store the line
-    if (instructions.size() <= currentLine)
-        instructions.resize(currentLine + 1);
+// Emits exactly `budget` executed lines of random instructions, nesting FOR blocks while depth allows
+void generateBlock(ProgramBuilder& builder, uint64_t budget, int depth, mt19937& gen, uint32_t& varCount, uint32_t memorySize) {
+    uniform_int_distribution<> cmdDistrib(0, 7);
+    uniform_int_distribution<> valDistrib(1, 100);
+    uniform_int_distribution<uint32_t> addrDistrib(0, memorySize / 2 - 1);
+    auto anyVar = [&]() { return "v" + to_string(gen() % varCount); };
+    auto anyAddress = [&]() { stringstream ss; ss << "0x" << hex << addrDistrib(gen) * 2; return ss.str(); };
+
+    uint64_t used = 0;
+    while (used < budget) {
+        int cmd = cmdDistrib(gen);
+        uint64_t remaining = budget - used;
+
+        if (depth < MAX_FOR_DEPTH && remaining > 2 * MAX_GENERATED_BODY && varCount > 0) {
+            // Long bursts become real loops, so the compiled program stays a few hundred ops at most
+            uint64_t bodyLines = max<uint64_t>(1 + gen() % MAX_GENERATED_BODY, (remaining + 65534) / 65535);
+            uint64_t repeats = min<uint64_t>(65535, remaining / bodyLines);
+            builder.beginFor(to_string(repeats));
+            generateBlock(builder, bodyLines, depth + 1, gen, varCount, memorySize);
+            builder.endFor();
+            used += bodyLines * repeats;
+            continue;
+        }
+
+        if (cmd == 7 && depth < MAX_FOR_DEPTH && remaining >= 2 && varCount > 0) {
+            uint32_t repeats = 2 + gen() % 3;
+            uint64_t bodyLines = min<uint64_t>(1 + gen() % 4, remaining / repeats);
+            if (bodyLines > 0) {
+                builder.beginFor(to_string(repeats));
+                generateBlock(builder, bodyLines, depth + 1, gen, varCount, memorySize);
+                builder.endFor();
+                used += bodyLines * repeats;
+                continue;
+            }
+        }
 
-    string prefix = "(" + generateTimestamp() + ") Core: " + to_string(coreId) + " ";
+        if (varCount == 0 || (cmd == 1 && varCount < MAX_GENERATED_VARS)) {
+            builder.declare("v" + to_string(varCount++), to_string(valDistrib(gen)));
+        }
+        else if (cmd == 0) {
+            builder.print(anyVar());
+        }
+        else if (cmd == 2) {
+            builder.arithmetic(OpCode::ADD, anyVar(), anyVar(), gen() % 2 ? anyVar() : to_string(valDistrib(gen)));
+        }
+        else if (cmd == 3) {
+            builder.arithmetic(OpCode::SUBTRACT, anyVar(), anyVar(), gen() % 2 ? anyVar() : to_string(valDistrib(gen)));
+        }
+        else if (cmd == 4) {
+            builder.sleep("100");
+        }
+        else if (cmd == 5) {
+            builder.write(anyAddress(), anyVar());
+        }
+        else if (cmd == 6) {
+            builder.read(anyVar(), anyAddress());
+        }
+        else {
+            // FOR that did not fit: the old single-line increment
+            string var = anyVar();
+            builder.arithmetic(OpCode::ADD, var, var, "1");
+        }
+        ++used;
+    }
+}
 
-    // Random instruction generation
+void process_instructions(uint64_t cpuBurst, ProgramBuilder& builder, uint32_t memorySize) {
     static thread_local mt19937 gen(random_device{}());
-    uniform_int_distribution<> cmdDistrib(0, 5);
-    uniform_int_distribution<> valDistrib(1, 100);
+    uint32_t varCount = 0;
+    generateBlock(builder, cpuBurst, 0, gen, varCount, memorySize);
+}
+
 
+enum class ProcessState : uint8_t {
+    Queued,
+    Running,
+    Finished
+};
+
+// One executed line, kept as raw values and only turned into text when someone looks at it
+struct LogEntry {
+    time_t time;
+    uint32_t pc;          // op that ran; the program itself supplies opcode and operand names
+    int coreId;
+    uint16_t valA = 0;
+    uint16_t valB = 0;
+    uint16_t result = 0;
+};
+
+string formatAddress(uint32_t address) {
     stringstream ss;
+    ss << "0x" << uppercase << hex << address;
+    return ss.str();
+}
+
+string formatLogEntry(const Program& program, const LogEntry& entry) {
+    const Op& op = program.ops[entry.pc];
+    const vector<string>& names = program.varNames;
+    auto operand = [&names](const Operand& operand, uint16_t value) {
+        return operand.isVar ? names[operand.value] + "(" + to_string(value) + ")" : to_string(operand.value);
+    };
+
     stringstream log;
-    int cmd = cmdDistrib(gen);
-
-    // Track declared vars
-    static thread_local vector<string> varNames;
-
-    if (cmd == 1 || varNames.empty()) {
-        // DECLARE
-        string var = "v" + to_string(varNames.size());
-        uint16_t val = valDistrib(gen);
-        memory[var] = val;
-        varNames.push_back(var);
-        log << "DECLARE " << var << " = " << val;
-    }
-    else if (cmd == 0 && !varNames.empty()) {
-        // PRINT
-        string var = varNames[gen() % varNames.size()];
-        uint16_t val = memory.count(var) ? memory[var] : 0;
-        log << "PRINT " << var << " = " << val;
-    }
-    else if (cmd == 2 && varNames.size() >= 2) {
-        // ADD
-        string a = varNames[gen() % varNames.size()];
-        string b = varNames[gen() % varNames.size()];
-        uint16_t valA = memory.count(a) ? memory[a] : 0;
-        uint16_t valB = memory.count(b) ? memory[b] : 0;
-        uint16_t result = clampUint16(valA + valB);
-        string resultVar = "res" + to_string(currentLine);
-        memory[resultVar] = result;
-        log << "ADD " << a << "(" << valA << ") + " << b << "(" << valB << ") = " << result;
-    }
-    else if (cmd == 3 && varNames.size() >= 2) {
-        // SUBTRACT
-        string a = varNames[gen() % varNames.size()];
-        string b = varNames[gen() % varNames.size()];
-        uint16_t valA = memory.count(a) ? memory[a] : 0;
-        uint16_t valB = memory.count(b) ? memory[b] : 0;
-        uint16_t result = clampUint16(valA - valB);
-        string resultVar = "res" + to_string(currentLine);
-        memory[resultVar] = result;
-        log << "SUBTRACT " << a << "(" << valA << ") - " << b << "(" << valB << ") = " << result;
-    }
-    else if (cmd == 4) {
-        // SLEEP
-        int ms = 100;
-        this_thread::sleep_for(chrono::milliseconds(ms));
-        log << "SLEPT for " << ms << "ms";
+    log << "(" << generateTimestamp(entry.time) << ") Core: " << entry.coreId << " \"";
+    switch (op.code) {
+    case OpCode::DECLARE:
+        log << "DECLARE " << names[op.dst] << " = " << op.a.value;
+        break;
+    case OpCode::PRINT:
+        log << "PRINT " << names[op.dst] << " = " << entry.result;
+        break;
+    case OpCode::ADD:
+    case OpCode::SUBTRACT: {
+        bool add = op.code == OpCode::ADD;
+        log << (add ? "ADD " : "SUBTRACT ") << names[op.dst] << " = " << operand(op.a, entry.valA)
+            << (add ? " + " : " - ") << operand(op.b, entry.valB) << " = " << entry.result;
+        break;
     }
-    else {
-        // FOR
-        if (varNames.empty()) {
-            string var = "v" + to_string(varNames.size());
-            uint16_t val = valDistrib(gen);
-            memory[var] = val;
-            varNames.push_back(var);
+    case OpCode::SLEEP:
+        log << "SLEPT for " << op.a.value << "ms";
+        break;
+    case OpCode::READ:
+        log << "READ " << names[op.dst] << " = [" << formatAddress(op.a.value) << "] " << entry.result;
+        break;
+    case OpCode::WRITE:
+        log << "WRITE [" << formatAddress(op.a.value) << "] = " << operand(op.b, entry.valB);
+        break;
+    default:
+        break;
+    }
+    log << "\"";
+    return log.str();
+}
+
+// Last `capacity` executed lines of a process. Entries pushed out of the ring are rendered to
+// spillPath when one is set, in batches, so memory stays bounded however long the burst is.
+class ExecutionLog {
+private:
+    vector<LogEntry> ring;
+    size_t capacity = 100;
+    size_t head = 0;             // oldest entry once the ring is full
+    uint64_t evicted = 0;
+    string spillPath;
+    string spillBuffer;
+    mutable mutex logMutex;      // the owning core appends while process-smi reads
+
+    void writeSpill() {
+        if (spillBuffer.empty()) return;
+        ofstream file(spillPath, ios::app);
+        file << spillBuffer;
+        spillBuffer.clear();
+    }
+
+public:
+    void configure(size_t entries, const string& spillFile) {
+        lock_guard<mutex> lock(logMutex);
+        capacity = entries;
+        spillPath = spillFile;
+    }
+
+    void record(const LogEntry& entry, const Program& program) {
+        lock_guard<mutex> lock(logMutex);
+        if (ring.size() < capacity) {
+            ring.push_back(entry);
+            return;
+        }
+        if (!spillPath.empty()) {
+            spillBuffer += formatLogEntry(program, ring[head]);
+            spillBuffer += '\n';
+            if (spillBuffer.size() >= 4096) writeSpill();
         }
+        ring[head] = entry;
+        head = (head + 1) % capacity;
+        ++evicted;
+    }
 
-        string var = varNames[gen() % varNames.size()];
-        int count = 3;
-        if (!memory.count(var)) memory[var] = 0;
+    void flushSpill() {
+        lock_guard<mutex> lock(logMutex);
+        writeSpill();
+    }
 
-        log << "FOR loop on " << var << ": ";
-        for (int i = 0; i < count; ++i) {
-            memory[var]++;
-            log << "[" << i + 1 << "]=" << memory[var] << " ";
+    // process-smi shows no lines for a finished process, so its ring can go; with a spill file
+    // the lines still in the ring are written there first so the file ends with the last line run
+    void release(const Program& program) {
+        lock_guard<mutex> lock(logMutex);
+        if (!spillPath.empty()) {
+            for (size_t i = 0; i < ring.size(); ++i) {
+                spillBuffer += formatLogEntry(program, ring[(head + i) % ring.size()]);
+                spillBuffer += '\n';
+            }
         }
+        writeSpill();
+        vector<LogEntry>().swap(ring);
+        head = 0;
     }
 
-    // Save result in instruction log
-    instructions[currentLine] = prefix + "\"" + log.str() + "\"";
+    // Oldest first; anything still buffered for the spill file is written so it can be read there
+    vector<LogEntry> snapshot(uint64_t& olderEntries) {
+        lock_guard<mutex> lock(logMutex);
+        writeSpill();
+        olderEntries = evicted;
+        vector<LogEntry> entries(ring.begin() + head, ring.end());
+        entries.insert(entries.end(), ring.begin(), ring.begin() + head);
+        return entries;
+    }
+
+    const string& spillFile() const { return spillPath; }
+};
+
+// Process names end up in file names, so only letters, digits, '_' and '-' are allowed
+bool isValidProcessName(const string& name) {
+    return !name.empty() && all_of(name.begin(), name.end(), [](char c) {
+        return isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-';
+        });
 }
 
+// Spilled log lines of a process go to process-logs/<name>.txt, starting empty.
+// Returns "" (spilling off for this process) if the file cannot be prepared.
+string spillPathFor(const string& name) {
+    error_code ec;
+    filesystem::create_directories("process-logs", ec);
+    string path = "process-logs/" + name + ".txt";
+    if (!ec) filesystem::remove(path, ec);
+    if (ec) {
+        cerr << "Cannot prepare " << path << " (" << ec.message() << "); spilling disabled for " << name << endl;
+        return "";
+    }
+    return path;
+}
 
 struct Process {
     int id;
     string name;
-    uint64_t currentLine = 0;
+    atomic<uint64_t> currentLine{ 0 };   // advanced by the owning core, read by listings
     uint64_t totalLine = 100;
     string timestamp;
-    int coreAssigned = -1;
+    atomic<int> coreAssigned{ -1 };      // written under queueMutex, read by process-smi
     bool isFinished = false;
+    atomic<ProcessState> state{ ProcessState::Queued };    // written under queueMutex
     string finishedTime;
-    vector<string> instructions;
-    unordered_map<string, uint16_t> memory;
+    ExecutionLog log;
+    shared_ptr<const Program> program;      // released once finished; readers take it with atomic_load
+    size_t pc = 0;                  // next op in program.ops
+    vector<uint32_t> loopStack;     // iterations left for each FOR being executed
+    vector<uint16_t> variables;     // indexed by program slot
+    vector<uint8_t> memory;         // emulated memory, allocated on first READ/WRITE
 };
 
+// Executes the process's next instruction; loop bookkeeping ops are consumed without counting as a line.
+// SLEEP is returned rather than slept so the caller can spend it as milliseconds or as CPU ticks.
+uint32_t instructions_manager(Process& proc, int coreId) {
+    const Program& program = *proc.program;
+    const vector<Op>& ops = program.ops;
+    while (proc.pc < ops.size()) {
+        const Op& op = ops[proc.pc];
+        if (op.code == OpCode::FOR_BEGIN) {
+            proc.loopStack.push_back(op.a.value);
+            proc.pc++;
+        }
+        else if (op.code == OpCode::FOR_END) {
+            if (--proc.loopStack.back() > 0) {
+                proc.pc = op.target + 1;
+            }
+            else {
+                proc.loopStack.pop_back();
+                proc.pc++;
+            }
+        }
+        else {
+            break;
+        }
+    }
+    if (proc.pc >= ops.size()) return 0;
+
+    uint32_t sleepFor = 0;
+    LogEntry entry{ time(nullptr), static_cast<uint32_t>(proc.pc), coreId };
+    const Op& op = ops[proc.pc++];
+    auto value = [&proc](const Operand& operand) {
+        return operand.isVar ? proc.variables[operand.value] : static_cast<uint16_t>(operand.value);
+    };
+    if ((op.code == OpCode::READ || op.code == OpCode::WRITE) && proc.memory.empty()) {
+        proc.memory.assign(program.memorySize, 0);
+    }
+
+    switch (op.code) {
+    case OpCode::DECLARE:
+        proc.variables[op.dst] = static_cast<uint16_t>(op.a.value);
+        break;
+    case OpCode::PRINT:
+        entry.result = proc.variables[op.dst];
+        break;
+    case OpCode::ADD:
+    case OpCode::SUBTRACT:
+        entry.valA = value(op.a);
+        entry.valB = value(op.b);
+        entry.result = clampUint16(op.code == OpCode::ADD ? entry.valA + entry.valB : entry.valA - entry.valB);
+        proc.variables[op.dst] = entry.result;
+        break;
+    case OpCode::SLEEP:
+        sleepFor = op.a.value;
+        break;
+    case OpCode::READ:
+        entry.result = static_cast<uint16_t>(proc.memory[op.a.value] | (proc.memory[op.a.value + 1] << 8));
+        proc.variables[op.dst] = entry.result;
+        break;
+    case OpCode::WRITE:
+        entry.valB = value(op.b);
+        proc.memory[op.a.value] = static_cast<uint8_t>(entry.valB & 0xFF);
+        proc.memory[op.a.value + 1] = static_cast<uint8_t>(entry.valB >> 8);
+        break;
+    default:
+        break;
+    }
+
+    proc.log.record(entry, program);
+    return sleepFor;
+}
+
 void printProcessDetails(const Process& proc) {
     cout << "Process: " << proc.name << endl;
     cout << "ID: " << proc.id << endl;
@@ -328,7 +836,7 @@ void printProcessDetails(const Process& proc) {
     cout << "\033[0m";
 }
 
-void displayProcess(const Process& proc) {
+void displayProcess(Process& proc) {
     printProcessDetails(proc);
     string subCommand;
     while (true) {
@@ -345,11 +853,20 @@ void displayProcess(const Process& proc) {
             cout << "Logs:\n(" << proc.timestamp << ") Core: " << proc.coreAssigned << endl;
             cout << "\nCurrent instruction line " << proc.currentLine << endl;
             cout << "Lines of code: " << proc.totalLine << endl;
-            // Print only finished instructions
-            if (!proc.isFinished) {
-                for (uint64_t i = 0; i < proc.currentLine && i < proc.instructions.size(); ++i) {
-                    cout << "  - " << proc.instructions[i] << endl;
+            // Print only finished instructions, rendered from the bounded log on demand
+            shared_ptr<const Program> program = atomic_load(&proc.program);
+            if (!proc.isFinished && program) {
+                uint64_t olderEntries = 0;
+                vector<LogEntry> entries = proc.log.snapshot(olderEntries);
+                ostringstream out;
+                if (olderEntries > 0) {
+                    out << "  ... " << olderEntries << " earlier line(s)"
+                        << (proc.log.spillFile().empty() ? " dropped" : " in " + proc.log.spillFile()) << '\n';
+                }
+                for (const LogEntry& entry : entries) {
+                    out << "  - " << formatLogEntry(*program, entry) << '\n';
                 }
+                cout << out.str();
             }
             else {
                 cout << "\nStatus: finished\n";
@@ -362,214 +879,800 @@ void displayProcess(const Process& proc) {
     }
 }
 
+deque<Process*> fcfsQueue;
+deque<Process*> rrQueue;
+mutex queueMutex;
+condition_variable cv;
+condition_variable parkCv;
+bool stopScheduler = false;
+bool stopProcessCreation = false;
+// Workers with coreId above this are parked; reconfigure moves it without joining threads
+atomic<int> activeCPUs{ 0 };
+
+// Processes of each state ordered by id, moved alongside the queues under queueMutex
+map<int, Process*> stateIndex[3];
+
+// Caller holds queueMutex
+void setProcessState(Process* proc, ProcessState state) {
+    stateIndex[static_cast<int>(proc->state.load())].erase(proc->id);
+    proc->state = state;
+    stateIndex[static_cast<int>(state)][proc->id] = proc;
+}
+
+// Lockstep cores that find the whole machine idle sleep on idleCv until idleWake moves
+// (new work, a batch hook, reconfigure or shutdown); all of them wait on the same mark
+condition_variable idleCv;
+uint64_t idleWake = 0;
+
+void wakeIdleCores() {
+    lock_guard<mutex> lock(queueMutex);
+    ++idleWake;
+    idleCv.notify_all();
+}
+
+// Scheduler whose queue workers read; only changes together with migrateQueuedWork, so any
+// queue picked under queueMutex is the one that will be dispatched from
+string activeScheduler = "rr";
+
+// Caller holds queueMutex
+deque<Process*>& activeQueue() {
+    return (activeScheduler == "fcfs") ? fcfsQueue : rrQueue;
+}
+
+void enqueueProcess(Process* proc) {
+    lock_guard<mutex> lock(queueMutex);
+    setProcessState(proc, ProcessState::Queued);
+    activeQueue().push_back(proc);
+    ++idleWake;
+    idleCv.notify_all();
+}
+
+// Makes `scheduler` the active one and moves everything waiting into its queue (caller holds queueMutex)
+void migrateQueuedWork(const string& scheduler) {
+    activeScheduler = scheduler;
+    deque<Process*>& from = (scheduler == "fcfs") ? rrQueue : fcfsQueue;
+    deque<Process*>& to = activeQueue();
+    to.insert(to.end(), from.begin(), from.end());
+    from.clear();
+}
+
+// Unfinished work goes back for another core in the given order; preempted fcfs jobs keep their
+// place ahead of newer arrivals (caller holds queueMutex)
+void returnToQueue(const vector<Process*>& procs) {
+    for (Process* proc : procs) {
+        proc->coreAssigned = -1;
+        setProcessState(proc, ProcessState::Queued);
+    }
+    deque<Process*>& queue = activeQueue();
+    queue.insert(activeScheduler == "fcfs" ? queue.begin() : queue.end(), procs.begin(), procs.end());
+    ++idleWake;
+    idleCv.notify_all();
+}
+
+void requeueProcess(Process* proc) {
+    lock_guard<mutex> lock(queueMutex);
+    returnToQueue({ proc });
+    cv.notify_one();
+}
+
+// Lockstep mode: the global CPU tick advances only once every active core has finished its cycle.
+// Arrivals combine up a tree with at most BARRIER_FAN_IN cores per node, and the release travels
+// back down the same tree, so no counter, mutex or condition variable is shared by more than a
+// handful of threads. The last arrival at the root is the only thread running at the tick
+// boundary: it requeues work handed back during the tick, applies any num-cpu change, paces the
+// tick, runs the batch hook and decides whether the machine has gone idle.
+const int BARRIER_FAN_IN = 4;
+const int MAX_BARRIER_CORES = 128;       // num-cpu upper bound
+const int EPOCH_CORE_BITS = 8;
+
+class TickBarrier {
+private:
+    struct alignas(64) Node {
+        atomic<int> pending{ 0 };
+        int expected = 0;
+        int parent = -1;
+        atomic<uint64_t> released{ 0 };  // latest tick handed down to the cores waiting here
+        mutex wakeMutex;
+        condition_variable wakeCv;
+    };
+
+    vector<Node> nodes;                  // leaves first, root last; sized once for MAX_BARRIER_CORES
+    // Tick << EPOCH_CORE_BITS | participant count. Both change together at a boundary, so a core
+    // never pairs a new tick with an old count, and the tick part only ever goes up.
+    atomic<uint64_t> epoch{ 0 };
+    atomic<bool> stopped{ false };
+    mutex joinMutex;                     // cores outside the participant set wait here
+    condition_variable joinCv;
+
+    atomic<Process*> held[MAX_BARRIER_CORES + 1] = {};   // per core id: preempted this tick, queued at the boundary
+    atomic<int> busyCores{ 0 };          // arrivals this tick that ran or still hold a process
+    atomic<uint64_t> idleMark{ 0 };      // idleWake + 1 when the last tick found nothing to do, else 0
+    atomic<uint64_t> periodUs{ 0 };      // minimum real duration of a tick
+    chrono::steady_clock::time_point lastRelease;
+
+    mutex hookMutex;
+    function<void(uint64_t)> tickHook;   // run by the releasing core before the new tick starts
+    atomic<bool> hookInstalled{ false };
+
+    static size_t nodeCount(int count) {
+        size_t total = 0;
+        for (size_t level = (count + BARRIER_FAN_IN - 1) / BARRIER_FAN_IN; ; level = (level + BARRIER_FAN_IN - 1) / BARRIER_FAN_IN) {
+            total += level;
+            if (level == 1) break;
+        }
+        return total;
+    }
+
+    // Rewires the first nodes into a tree for `count` cores. Only the releasing core (or initialize)
+    // calls this; cores still waiting from the old layout are woken through their recorded nodes.
+    void build(int count) {
+        size_t levelStart = 0;
+        size_t levelSize = (count + BARRIER_FAN_IN - 1) / BARRIER_FAN_IN;
+        int children = count;
+        while (true) {
+            for (size_t i = 0; i < levelSize; ++i) {
+                Node& node = nodes[levelStart + i];
+                node.expected = min<int>(BARRIER_FAN_IN, children - static_cast<int>(i) * BARRIER_FAN_IN);
+                node.pending.store(node.expected, memory_order_relaxed);
+                node.parent = levelSize == 1 ? -1 : static_cast<int>(levelStart + levelSize + i / BARRIER_FAN_IN);
+            }
+            if (levelSize == 1) break;
+            children = static_cast<int>(levelSize);
+            levelStart += levelSize;
+            levelSize = (levelSize + BARRIER_FAN_IN - 1) / BARRIER_FAN_IN;
+        }
+    }
+
+    // Queues what cores 1..upTo handed back, lowest core id first
+    void returnHeld(int upTo) {
+        vector<Process*> procs;
+        for (int coreId = 1; coreId <= upTo; ++coreId) {
+            if (Process* proc = held[coreId].exchange(nullptr)) procs.push_back(proc);
+        }
+        if (procs.empty()) return;
+        lock_guard<mutex> lock(queueMutex);
+        returnToQueue(procs);
+    }
+
+    // Everything the releasing core does between the last arrival and publishing the next tick
+    void release(uint64_t arrived) {
+        int count = static_cast<int>(epoch.load() & ((1 << EPOCH_CORE_BITS) - 1));
+        returnHeld(count);
+
+        int wanted = activeCPUs.load();
+        if (wanted != count) build(wanted);
+
+        auto period = chrono::microseconds(periodUs.load());
+        auto due = lastRelease + period;
+        if (period.count() > 0 && chrono::steady_clock::now() < due) {
+            this_thread::sleep_until(due);
+            lastRelease = due;
+        }
+        else {
+            lastRelease = chrono::steady_clock::now();
+        }
+
+        uint64_t next = arrived + 1;
+        {
+            lock_guard<mutex> lock(hookMutex);
+            if (tickHook) tickHook(next);
+        }
+
+        // queueMutex is only needed on the rare tick where no core had anything to run
+        uint64_t mark = 0;
+        if (busyCores.load() == 0 && !hookInstalled.load()) {
+            lock_guard<mutex> lock(queueMutex);
+            if (activeQueue().empty()) mark = idleWake + 1;
+        }
+        busyCores.store(0);
+        idleMark.store(mark);
+
+        uint64_t published = next << EPOCH_CORE_BITS | static_cast<uint64_t>(wanted);
+        if (wanted != count) {
+            {
+                lock_guard<mutex> lock(joinMutex);
+                epoch.store(published, memory_order_release);
+            }
+            joinCv.notify_all();
+        }
+        else {
+            epoch.store(published, memory_order_release);
+        }
+    }
+
+    void publish(int node, uint64_t tick) {
+        {
+            lock_guard<mutex> lock(nodes[node].wakeMutex);
+            nodes[node].released.store(tick, memory_order_release);
+        }
+        nodes[node].wakeCv.notify_all();
+    }
+
+    void waitAt(int node, uint64_t arrived) {
+        Node& waitNode = nodes[node];
+        auto released = [&] { return waitNode.released.load(memory_order_acquire) > arrived || stopped.load(); };
+        // A paced tick is long enough that spinning only burns the core the releaser is waiting on
+        int spins = periodUs.load() == 0 ? 1000 : 0;
+        for (int spin = 0; spin < spins; ++spin) {
+            if (released()) return;
+            this_thread::yield();
+        }
+        unique_lock<mutex> lock(waitNode.wakeMutex);
+        waitNode.wakeCv.wait(lock, released);
+    }
+
+public:
+    TickBarrier() : nodes(nodeCount(MAX_BARRIER_CORES)) {}
+
+    // Only while no worker is running
+    void reset(int count) {
+        returnHeld(MAX_BARRIER_CORES);
+        for (Node& node : nodes) node.released.store(0);
+        build(count);
+        epoch.store(static_cast<uint64_t>(count));
+        busyCores.store(0);
+        idleMark.store(0);
+        stopped.store(false);
+    }
+
+    void stop() {
+        {
+            lock_guard<mutex> lock(joinMutex);
+            stopped.store(true);
+        }
+        joinCv.notify_all();
+        for (size_t i = 0; i < nodes.size(); ++i) publish(static_cast<int>(i), nodes[i].released.load());
+        wakeIdleCores();
+    }
+
+    void setPeriod(uint64_t microseconds) { periodUs.store(microseconds); }
+
+    // Installs (or clears, with nullptr) the per-tick hook; never called from inside the hook
+    void setTickHook(function<void(uint64_t)> hook) {
+        {
+            lock_guard<mutex> lock(hookMutex);
+            tickHook = move(hook);
+            hookInstalled.store(static_cast<bool>(tickHook));
+        }
+        wakeIdleCores();
+    }
+
+    // Non-zero when the tick this core just finished had no work anywhere; every core sees the same
+    // value. A core dropped at that boundary gets 0: later ticks run without it, so the mark may
+    // already describe one of those, and it still has to give back its process.
+    uint64_t idleSince(int coreId) const { return participates(coreId) ? idleMark.load() : 0; }
+
+    uint64_t currentTick() const { return epoch.load() >> EPOCH_CORE_BITS; }
+
+    bool participates(int coreId) const {
+        return static_cast<uint64_t>(coreId) <= (epoch.load(memory_order_acquire) & ((1 << EPOCH_CORE_BITS) - 1));
+    }
+
+    // A process this core preempted mid-tick; it reaches the queue at the tick boundary, so no other
+    // core can run it again in the same tick and queue order does not depend on who got there first
+    void holdForRequeue(int coreId, Process* proc) { held[coreId].store(proc); }
+
+    // Ends this core's cycle and returns once the tick it arrived on is over (or the barrier is stopped)
+    void arriveAndWait(int coreId, bool busy) {
+        uint64_t arrived = epoch.load(memory_order_acquire) >> EPOCH_CORE_BITS;
+        if (busy) busyCores.fetch_add(1, memory_order_relaxed);
+
+        int completed[8];                // nodes this core was last to reach, leaf first
+        int depth = 0;
+        int node = (coreId - 1) / BARRIER_FAN_IN;
+        bool releaser = false;
+        while (nodes[node].pending.fetch_sub(1, memory_order_acq_rel) == 1) {
+            // Last one here: re-arm the node for the next tick before climbing
+            nodes[node].pending.store(nodes[node].expected, memory_order_relaxed);
+            completed[depth++] = node;
+            if (nodes[node].parent < 0) {
+                release(arrived);
+                releaser = true;
+                break;
+            }
+            node = nodes[node].parent;
+        }
+        if (!releaser) waitAt(node, arrived);
+
+        // Pass the release down to the nodes this core completed, nearest the root first
+        for (int i = depth - 1; i >= 0; --i) publish(completed[i], arrived + 1);
+    }
+
+    // For cores outside the current participant set; returns once this core is let back in,
+    // on stop, or after `timeout` so callers can poll their own exit flags
+    void waitToJoin(int coreId, chrono::milliseconds timeout) {
+        unique_lock<mutex> lock(joinMutex);
+        joinCv.wait_for(lock, timeout, [&] { return participates(coreId) || stopped.load(); });
+    }
+};
+
+TickBarrier tickBarrier;
+
+// screen -ls [--state running|queued|finished] [--prefix <name>] [--top <n>] [--page <n>] [--page-size <n>]
+struct ListOptions {
+    bool filterState = false;
+    ProcessState state = ProcessState::Running;
+    string prefix;
+    size_t top = 0;          // 0 = every match, otherwise the n with most instructions left
+    size_t page = 0;         // 0 = no paging
+    size_t pageSize = 20;
+};
+
 class ProcessManager {
 private:
     unordered_map<string, unique_ptr<Process>> processes;
+    map<string, Process*> byName;    // ordered view of processes for prefix listings
+    mutable mutex registryMutex;     // processes is filled by the batch thread while the shell reads it
     int nextProcessID = 1;
-public:
-    void createProcess(string name) {
-        if (processes.find(name) != processes.end()) {
-            cout << "Process " << name << " already exists." << endl;
-            return;
+    int nextBatchIndex = 1;
+
+    // One listed process. The core is copied under queueMutex together with the state it was listed
+    // in, and the count --top sorts on is read once so the order cannot shift mid-sort.
+    struct ListRow {
+        Process* proc;
+        int core;
+        uint64_t remaining;
+    };
+
+    // Candidates for a section in id order. A prefix is looked up in the name index, then filtered by
+    // state under queueMutex; otherwise only the requested window of the state index is copied under
+    // it, walked from whichever end is closer. `matches` is the full size of the selection.
+    vector<ListRow> selectSection(ProcessState state, const ListOptions& options, size_t skip, size_t limit, size_t& matches) const {
+        vector<ListRow> selected;
+        if (!options.prefix.empty()) {
+            vector<Process*> named;
+            {
+                lock_guard<mutex> lock(registryMutex);
+                for (auto it = byName.lower_bound(options.prefix);
+                    it != byName.end() && it->first.compare(0, options.prefix.size(), options.prefix) == 0; ++it) {
+                    named.push_back(it->second);
+                }
+            }
+            {
+                lock_guard<mutex> lock(queueMutex);
+                for (Process* proc : named) {
+                    if (proc->state == state) selected.push_back({ proc, proc->coreAssigned, 0 });
+                }
+            }
+            sort(selected.begin(), selected.end(), [](const ListRow& a, const ListRow& b) { return a.proc->id < b.proc->id; });
+            matches = selected.size();
+            if (skip >= selected.size()) return {};
+            selected.erase(selected.begin(), selected.begin() + skip);
+            if (selected.size() > limit) selected.resize(limit);
+            return selected;
         }
-        uint64_t cpuBurst = cpuBurstGenerator();
-        vector<string> instructions;
-        processes[name] = make_unique<Process>(Process{
-            nextProcessID++,
-            name,
-            0,
-            cpuBurst,
-            generateTimestamp(),
-            -1,
-            false,
-            "",
-            instructions
-            });
-    }
 
-    Process* retrieveProcess(const string& name) {
-        auto it = processes.find(name);
-        return it != processes.end() ? it->second.get() : nullptr;
+        lock_guard<mutex> lock(queueMutex);
+        const map<int, Process*>& index = stateIndex[static_cast<int>(state)];
+        matches = index.size();
+        if (skip >= index.size()) return {};
+        size_t count = min(limit, index.size() - skip);
+        if (skip <= index.size() / 2) {
+            auto it = next(index.begin(), skip);
+            for (size_t i = 0; i < count; ++i, ++it) selected.push_back({ it->second, it->second->coreAssigned, 0 });
+        }
+        else {
+            auto it = next(index.rbegin(), index.size() - skip - count);
+            for (size_t i = 0; i < count; ++i, ++it) selected.push_back({ it->second, it->second->coreAssigned, 0 });
+            reverse(selected.begin(), selected.end());
+        }
+        return selected;
     }
 
-    void listProcesses() {
-        cout << "-----------------------------\n";
+    // Appends one section; rows are formatted after every lock is released
+    void renderSection(ostream& out, ProcessState state, const ListOptions& options, bool color) const {
+        bool paged = options.page > 0;
+        size_t skip = paged ? (options.page - 1) * options.pageSize : 0;
+        size_t limit = paged ? options.pageSize : SIZE_MAX;
+        size_t matches = 0;
+
+        vector<ListRow> rows;
+        if (options.top > 0) {
+            // Paging walks the top list, so every candidate has to be ranked first
+            rows = selectSection(state, options, 0, SIZE_MAX, matches);
+            for (ListRow& row : rows) {
+                row.remaining = row.proc->totalLine - min<uint64_t>(row.proc->currentLine, row.proc->totalLine);
+            }
+            size_t keep = min(options.top, rows.size());
+            partial_sort(rows.begin(), rows.begin() + keep, rows.end(), [](const ListRow& a, const ListRow& b) {
+                return a.remaining > b.remaining;
+                });
+            rows.resize(keep);
+            matches = rows.size();
+            rows.erase(rows.begin(), rows.begin() + min(skip, rows.size()));
+            if (rows.size() > limit) rows.resize(limit);
+        }
+        else {
+            rows = selectSection(state, options, skip, limit, matches);
+        }
 
-        // Track cores being used
-        unordered_set<int> coresUsedSet;
-        for (const auto& [name, proc] : processes) {
-            if (!proc->isFinished && proc->coreAssigned != -1) {
-                coresUsedSet.insert(proc->coreAssigned);
+        const char* yellow = color ? "\033[33m" : "";
+        const char* reset = color ? "\033[0m" : "";
+        for (const ListRow& row : rows) {
+            const Process* proc = row.proc;
+            if (state == ProcessState::Running) {
+                out << proc->name << yellow << (color ? "  (" : " (") << proc->timestamp << ") " << reset
+                    << "Core: " << row.core << " " << yellow
+                    << proc->currentLine << " / " << proc->totalLine << reset << '\n';
             }
+            else if (state == ProcessState::Queued) {
+                out << proc->name << " (" << proc->timestamp << ") Queued "
+                    << proc->currentLine << " / " << proc->totalLine << '\n';
+            }
+            else {
+                out << proc->name << " (" << proc->finishedTime << ") Finished "
+                    << proc->totalLine << " / " << proc->totalLine << '\n';
+            }
+        }
+        if (paged) {
+            out << "Page " << options.page << " of " << max<size_t>(1, (matches + options.pageSize - 1) / options.pageSize)
+                << " (" << matches << " matching)\n";
         }
+    }
 
+    void renderReport(ostream& out, const ListOptions& options, bool color) const {
+        size_t coresUsed;
+        {
+            lock_guard<mutex> lock(queueMutex);
+            coresUsed = stateIndex[static_cast<int>(ProcessState::Running)].size();
+        }
         int coresAvailable = GLOBAL_CONFIG.numCPU;
-        int coresUsed = static_cast<int>(coresUsedSet.size());
         double utilization = (coresAvailable > 0) ? (static_cast<double>(coresUsed) / coresAvailable) * 100.0 : 0.0;
-        coresAvailable = coresAvailable - coresUsed;
+        coresAvailable = coresAvailable - static_cast<int>(coresUsed);
+
+        out << "-----------------------------\n";
+        out << fixed << setprecision(2);
+        out << "CPU Utilization: " << utilization << "%\n";
+        out << "Cores Used:      " << coresUsed << "\n";
+        out << "Cores Available: " << coresAvailable << "\n";
+        if (configSnapshot().lockstep) {
+            out << "CPU Tick:        " << tickBarrier.currentTick() << "\n";
+        }
+        out << "-----------------------------\n";
+
+        static const pair<ProcessState, const char*> sections[] = {
+            { ProcessState::Running, "Running processes:\n" },
+            { ProcessState::Queued, "Queued processes:\n" },
+            { ProcessState::Finished, "Finished processes:\n" },
+        };
+        bool first = true;
+        for (const auto& [state, title] : sections) {
+            // Without a filter the report keeps its usual running + finished layout
+            if (options.filterState ? state != options.state : state == ProcessState::Queued) continue;
+            out << (first ? "" : "\n") << title;
+            renderSection(out, state, options, color);
+            first = false;
+        }
 
-        // Display core usage stats
-        cout << fixed << setprecision(2);
-        cout << "CPU Utilization: " << utilization << "%\n";
-        cout << "Cores Used:      " << coresUsed << "\n";
-        cout << "Cores Available: " << coresAvailable << "\n";
-        cout << "-----------------------------\n";
+        out << "-----------------------------\n";
+    }
 
-        // Running processes
-        cout << "Running processes:\n";
-        for (const auto& [name, proc] : processes) {
-            if (!proc->isFinished && proc->coreAssigned != -1) {
-                cout << name << "\033[33m  (" << proc->timestamp << ") \033[0m"
-                    << "Core: " << proc->coreAssigned << " \033[33m"
-                    << proc->currentLine << " / " << proc->totalLine << "\033[0m" << endl;
-            }
+public:
+    // Compiles `source` (or a random program of cpuBurst lines when empty); false if nothing was created
+    bool createProcess(const string& name, uint32_t memorySize = DEFAULT_PROCESS_MEMORY, const string& source = "") {
+        if (!isValidProcessName(name)) {
+            cout << "Invalid process name " << name << ": use only letters, digits, '_' and '-'." << endl;
+            return false;
+        }
+        if (retrieveProcess(name) != nullptr) {
+            cout << "Process " << name << " already exists." << endl;
+            return false;
         }
 
-        // Finished processes
-        cout << "\nFinished processes:\n";
-        for (const auto& [name, proc] : processes) {
-            if (proc->isFinished) {
-                cout << name << " (" << proc->finishedTime << ") Finished "
-                    << proc->totalLine << " / " << proc->totalLine << endl;
+        ProgramBuilder builder(memorySize);
+        bool parsed = true;
+        if (source.empty()) {
+            process_instructions(cpuBurstGenerator(), builder, memorySize);
+        }
+        else {
+            parsed = parseProgram(source, builder);
+        }
+        Program program;
+        if (!parsed || !builder.finish(program)) {
+            cout << "Invalid instructions for " << name << ": " << builder.error() << endl;
+            return false;
+        }
+
+        auto proc = make_unique<Process>();
+        proc->name = name;
+        proc->totalLine = program.totalLines;
+        proc->timestamp = generateTimestamp();
+        proc->variables.assign(program.varNames.size(), 0);
+        proc->program = make_shared<const Program>(move(program));
+
+        Process* created = proc.get();
+        {
+            lock_guard<mutex> lock(registryMutex);
+            if (processes.count(name)) {
+                cout << "Process " << name << " already exists." << endl;
+                return false;
             }
+            proc->id = nextProcessID++;
+            byName[name] = created;
+            processes[name] = move(proc);
         }
 
-        cout << "-----------------------------\n";
+        // Only the creator that won the name may reset its spill file; nothing runs until it is queued
+        SystemConfig config = configSnapshot();
+        created->log.configure(config.logEntries, config.logSpill ? spillPathFor(name) : "");
+        return true;
     }
 
-    void logProcesses(const string& filename) {
+    Process* retrieveProcess(const string& name) const {
+        lock_guard<mutex> lock(registryMutex);
+        auto it = processes.find(name);
+        return it != processes.end() ? it->second.get() : nullptr;
+    }
+
+    // Next free processNN name; the counter persists so restarting the scheduler never rescans
+    string nextBatchName() {
+        lock_guard<mutex> lock(registryMutex);
+        string name;
+        do {
+            name = "process" + (nextBatchIndex < 10 ? "0" + to_string(nextBatchIndex) : to_string(nextBatchIndex));
+            ++nextBatchIndex;
+        } while (processes.count(name));
+        return name;
+    }
+
+    // Writes out spill buffers of processes that have not finished yet
+    void flushLogs() {
+        lock_guard<mutex> lock(registryMutex);
+        for (auto& [name, proc] : processes) {
+            proc->log.flushSpill();
+        }
+    }
+
+    void listProcesses(const ListOptions& options = ListOptions()) const {
+        // One write to the terminal instead of a flush per line
+        ostringstream out;
+        renderReport(out, options, true);
+        cout << out.str() << flush;
+    }
+
+    void logProcesses(const string& filename) const {
         ofstream logFile(filename);
         if (!logFile.is_open()) {
             cerr << "Failed to create log file: " << filename << endl;
             return;
         }
 
-        logFile << "-----------------------------\n";
+        renderReport(logFile, ListOptions(), false);
+        logFile.close();
+        cout << "Report saved to csopesy-log.txt\n";
+    }
+
+};
 
-        unordered_set<int> coresUsedSet;
-        for (const auto& [name, proc] : processes) {
-            if (!proc->isFinished && proc->coreAssigned != -1) {
-                coresUsedSet.insert(proc->coreAssigned);
-            }
-        }
+// Takes the next process for this core (caller holds queueMutex)
+Process* dispatchProcess(int coreId) {
+    deque<Process*>& queue = activeQueue();
+    if (queue.empty()) return nullptr;
+    Process* proc = queue.front();
+    queue.pop_front();
+    proc->coreAssigned = coreId;
+    setProcessState(proc, ProcessState::Running);
+    return proc;
+}
 
-        int coresAvailable = GLOBAL_CONFIG.numCPU;
-        int coresUsed = static_cast<int>(coresUsedSet.size());
-        double utilization = (coresAvailable > 0) ? (static_cast<double>(coresUsed) / coresAvailable) * 100.0 : 0.0;
-        coresAvailable = coresAvailable - coresUsed;
+void finishProcess(Process* proc) {
+    proc->finishedTime = generateTimestamp();
+    proc->isFinished = true;
+    // Only the header survives a finished process: drop its program, log and emulated state
+    proc->log.release(*atomic_load(&proc->program));
+    atomic_store(&proc->program, shared_ptr<const Program>());
+    vector<uint16_t>().swap(proc->variables);
+    vector<uint8_t>().swap(proc->memory);
+    vector<uint32_t>().swap(proc->loopStack);
+    lock_guard<mutex> lock(queueMutex);
+    setProcessState(proc, ProcessState::Finished);
+}
 
-        logFile << fixed << setprecision(2);
-        logFile << "CPU Utilization: " << utilization << "%\n";
-        logFile << "Cores Used:      " << coresUsed << "\n";
-        logFile << "Cores Available: " << coresAvailable << "\n";
-        logFile << "-----------------------------\n";
+// One instruction or one waiting tick per cycle; delay-per-exec and SLEEP are counted in ticks
+void lockstepWorker(int coreId) {
+    SystemConfig config;
+    uint64_t seenVersion = ~0ULL;
+    Process* proc = nullptr;
+    string policy;
+    uint64_t executedInstructions = 0;
+    uint64_t waitTicks = 0;
 
-        logFile << "Running processes:\n";
-        for (const auto& [name, proc] : processes) {
-            if (!proc->isFinished && proc->coreAssigned != -1) {
-                logFile << name << " (" << proc->timestamp << ") "
-                    << "Core: " << proc->coreAssigned << " "
-                    << proc->currentLine << " / " << proc->totalLine << endl;
+    while (!stopScheduler) {
+        if (!tickBarrier.participates(coreId)) {
+            if (proc) {
+                requeueProcess(proc);
+                proc = nullptr;
             }
+            tickBarrier.waitToJoin(coreId, chrono::milliseconds(100));
+            continue;
+        }
+
+        refreshConfig(config, seenVersion);
+        bool handedOver = false;
+        if (proc && policy != config.scheduler && waitTicks == 0) {
+            // Scheduler switched by reconfigure: hand the process over to the new queue, and sit out
+            // this tick so the one hand-back slot this core has is not needed twice
+            tickBarrier.holdForRequeue(coreId, proc);
+            proc = nullptr;
+            handedOver = true;
         }
+        if (!proc && !handedOver) {
+            lock_guard<mutex> lock(queueMutex);
+            proc = dispatchProcess(coreId);
+            policy = activeScheduler;
+            executedInstructions = 0;
+            waitTicks = 0;
+        }
+
+        bool busy = handedOver || proc != nullptr;
+        if (proc) {
+            if (waitTicks > 0) {
+                --waitTicks;
+            }
+            else {
+                uint32_t sleepTicks = instructions_manager(*proc, coreId);
+                proc->currentLine++;
+                executedInstructions++;
+                waitTicks = config.delayPerExec + sleepTicks;
+            }
 
-        logFile << "\nFinished processes:\n";
-        for (const auto& [name, proc] : processes) {
-            if (proc->isFinished) {
-                logFile << name << " (" << proc->finishedTime << ") Finished "
-                    << proc->totalLine << " / " << proc->totalLine << endl;
+            if (proc->currentLine >= proc->totalLine && waitTicks == 0) {
+                finishProcess(proc);
+                proc = nullptr;
+            }
+            else if (policy == "rr" && executedInstructions >= config.quantumCycles && waitTicks == 0) {
+                tickBarrier.holdForRequeue(coreId, proc);
+                proc = nullptr;
             }
         }
 
-        logFile << "-----------------------------\n";
-        logFile.close();
-        cout << "Report saved to csopesy-log.txt\n";
-    }
+        tickBarrier.arriveAndWait(coreId, busy);
 
-};
+        // Nothing ran and nothing is queued: every core sleeps here until work shows up
+        uint64_t idle = tickBarrier.idleSince(coreId);
+        if (idle != 0) {
+            unique_lock<mutex> lock(queueMutex);
+            idleCv.wait(lock, [idle] { return stopScheduler || idleWake + 1 != idle; });
+        }
+    }
 
-queue<Process*> fcfsQueue;
-queue<Process*> rrQueue;
-mutex queueMutex;
-condition_variable cv;
-bool stopScheduler = false;
-bool stopProcessCreation = false;
+    if (proc) {
+        requeueProcess(proc);
+    }
+}
 
 void cpuWorker(int coreId) {
+    if (configSnapshot().lockstep) {
+        lockstepWorker(coreId);
+        return;
+    }
+
+    SystemConfig config;
+    uint64_t seenVersion = ~0ULL;
     while (!stopScheduler) {
         Process* proc = nullptr;
+        string policy;
         {
             unique_lock<mutex> lock(queueMutex);
-            cv.wait(lock, [] { return (!fcfsQueue.empty() || !rrQueue.empty()) || stopScheduler; });
-
-            if (GLOBAL_CONFIG.scheduler == "fcfs" && !fcfsQueue.empty()) {
-                proc = fcfsQueue.front();
-                fcfsQueue.pop();
-            }
-            else if (GLOBAL_CONFIG.scheduler == "rr" && !rrQueue.empty()) {
-                proc = rrQueue.front();
-                rrQueue.pop();
+            if (coreId > activeCPUs) {
+                // Pass on any wakeup meant for an active core, then sleep apart from them
+                cv.notify_one();
+                parkCv.wait(lock, [coreId] { return stopScheduler || coreId <= activeCPUs; });
+                continue;
             }
+            cv.wait(lock, [coreId] {
+                return stopScheduler || coreId > activeCPUs || !activeQueue().empty();
+                });
+
+            refreshConfig(config, seenVersion);
+            proc = dispatchProcess(coreId);
+            policy = activeScheduler;
         }
 
         if (proc) {
-            proc->coreAssigned = coreId;
-
-            if (GLOBAL_CONFIG.scheduler == "fcfs") {
-                while (proc->currentLine < proc->totalLine && !stopScheduler) {
-                    instructions_manager(proc->currentLine, proc->instructions, proc->memory, proc->name, coreId);
-                    proc->currentLine++;
-                    this_thread::sleep_for(chrono::milliseconds(GLOBAL_CONFIG.delayPerExec));
-                }
-
+            // fcfs runs to completion, rr until the quantum expires; both yield if this core
+            // gets parked or the scheduler is switched underneath them
+            uint64_t executedInstructions = 0;
+            while (proc->currentLine < proc->totalLine && !stopScheduler && coreId <= activeCPUs) {
+                if (policy == "rr" && executedInstructions >= config.quantumCycles) break;
+
+                uint32_t sleepMs = instructions_manager(*proc, coreId);
+                proc->currentLine++;
+                executedInstructions++;
+                this_thread::sleep_for(chrono::milliseconds(config.delayPerExec + sleepMs));
+
+                refreshConfig(config, seenVersion);
+                if (config.scheduler != policy) break;
             }
-            else if (GLOBAL_CONFIG.scheduler == "rr") {
-                uint64_t executedInstructions = 0;
-                while (proc->currentLine < proc->totalLine &&
-                    executedInstructions < GLOBAL_CONFIG.quantumCycles &&
-                    !stopScheduler) {
-                    instructions_manager(proc->currentLine, proc->instructions, proc->memory, proc->name, coreId);
-                    proc->currentLine++;
-                    executedInstructions++;
-                    this_thread::sleep_for(chrono::milliseconds(GLOBAL_CONFIG.delayPerExec));
-                }
 
-                if (proc->currentLine < proc->totalLine) {
-                    lock_guard<mutex> lock(queueMutex);
-                    rrQueue.push(proc);
-                    cv.notify_one();
-                    continue;
-                }
+            if (proc->currentLine < proc->totalLine) {
+                requeueProcess(proc);
+                continue;
             }
-            proc->isFinished = true;
-            proc->finishedTime = generateTimestamp();
+            finishProcess(proc);
         }
     }
 }
 
+bool parseListOptions(const string& command, ListOptions& options) {
+    istringstream iss(command);
+    string cmd, option, flag, value;
+    iss >> cmd >> option;
+    auto count = [](const string& text, size_t& out) {
+        if (text.empty() || text.size() > 9 || !all_of(text.begin(), text.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); }) || stoul(text) == 0) return false;
+        out = stoul(text);
+        return true;
+    };
+
+    while (iss >> flag) {
+        if (!(iss >> value)) return false;
+        if (flag == "--state") {
+            options.filterState = true;
+            if (value == "running") options.state = ProcessState::Running;
+            else if (value == "queued") options.state = ProcessState::Queued;
+            else if (value == "finished") options.state = ProcessState::Finished;
+            else return false;
+        }
+        else if (flag == "--prefix") options.prefix = value;
+        else if (flag == "--top") { if (!count(value, options.top)) return false; }
+        else if (flag == "--page") { if (!count(value, options.page)) return false; }
+        else if (flag == "--page-size") {
+            if (!count(value, options.pageSize)) return false;
+            if (options.page == 0) options.page = 1;
+        }
+        else return false;
+    }
+    return true;
+}
+
 void handleScreenCommand(const string& command, ProcessManager& manager) {
     istringstream iss(command);
     string cmd, option, processName;
     iss >> cmd >> option >> processName;
 
     if (option == "-ls") {
-        manager.listProcesses();
+        ListOptions options;
+        if (parseListOptions(command, options)) {
+            manager.listProcesses(options);
+        }
+        else {
+            cout << "[screen] Usage: screen -ls [--state running|queued|finished] [--prefix <name>] "
+                << "[--top <n>] [--page <n>] [--page-size <n>]" << endl;
+        }
     }
     else if (option == "-s" && !processName.empty()) {
-        manager.createProcess(processName);
-        Process* proc = manager.retrieveProcess(processName);
-        if (proc) {
-            lock_guard<mutex> lock(queueMutex);
-            if (GLOBAL_CONFIG.scheduler == "fcfs") {
-                fcfsQueue.push(proc);
+        // screen -s <name> [memory-size] ["<instructions>"]
+        string rest;
+        getline(iss, rest);
+        size_t quote = rest.find('"');
+        istringstream sizeStream(rest.substr(0, quote));
+        string sizeToken, extra;
+        uint32_t memorySize = DEFAULT_PROCESS_MEMORY;
+        if (sizeStream >> sizeToken) {
+            uint64_t size = all_of(sizeToken.begin(), sizeToken.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); }) && sizeToken.size() <= 6 ? stoull(sizeToken) : 0;
+            if (size < 64 || size > 65536 || (size & (size - 1)) != 0 || sizeStream >> extra) {
+                cout << "[screen] Memory size must be a power of 2 between 64 and 65536." << endl;
+                return;
             }
-            else if (GLOBAL_CONFIG.scheduler == "rr") {
-                rrQueue.push(proc);
+            memorySize = static_cast<uint32_t>(size);
+        }
+        string source;
+        if (quote != string::npos) {
+            size_t closing = rest.rfind('"');
+            if (closing == quote) {
+                cout << "[screen] Missing closing quote around instructions." << endl;
+                return;
             }
+            source = rest.substr(quote + 1, closing - quote - 1);
+        }
+
+        Process* proc = manager.createProcess(processName, memorySize, source) ? manager.retrieveProcess(processName) : nullptr;
+        if (proc) {
+            enqueueProcess(proc);
+            cv.notify_one();
             displayProcess(*proc);
             printHeader();
         }
-        cv.notify_one();
     }
     else if (option == "-r" && !processName.empty()) {
         Process* proc = manager.retrieveProcess(processName);
@@ -588,40 +1691,81 @@ void handleScreenCommand(const string& command, ProcessManager& manager) {
 
 void scheduler_start(ProcessManager& manager) {
     // Automatically create N processes and queue them for running
-    int processCountName = 1;
     while (!stopScheduler) {
-        // Interruptible sleep/frequency
-        for (int frequency = 0; frequency < GLOBAL_CONFIG.batchProcessFreq && !stopProcessCreation; ++frequency) {
+        // Interruptible sleep/frequency, re-read every batch so reconfigure takes effect live
+        if (configSnapshot().lockstep) {
+            // batch-process-freq counts CPU ticks: the core closing every freq-th tick creates the
+            // batch before any core starts the next one, so it is dispatched on the same tick every run
+            tickBarrier.setTickHook([&manager](uint64_t tick) {
+                if (tick % configSnapshot().batchProcessFreq != 0) return;
+                string procName = manager.nextBatchName();
+                if (manager.createProcess(procName)) enqueueProcess(manager.retrieveProcess(procName));
+            });
+            while (!stopProcessCreation && !stopScheduler && configSnapshot().lockstep) {
+                this_thread::sleep_for(chrono::milliseconds(100));
+            }
+            tickBarrier.setTickHook(nullptr);
+            if (stopProcessCreation) break;
+            continue;   // initialize turned lockstep off: batches go back on the timer below
+        }
+
+        // Re-checked every step so lowering batch-process-freq cuts a long wait short
+        for (uint64_t frequency = 0; frequency < configSnapshot().batchProcessFreq && !stopProcessCreation; ++frequency) {
+            if (configSnapshot().lockstep) break;
             this_thread::sleep_for(chrono::milliseconds(100));
         }
         if (stopProcessCreation) break;
+        if (configSnapshot().lockstep) continue;
 
-        while (!stopProcessCreation) {
-            string procName = "process" + (processCountName < 10 ? "0" + to_string(processCountName) : to_string(processCountName));
-
-            if (manager.retrieveProcess(procName) == nullptr) {
-                manager.createProcess(procName);
-                Process* proc = manager.retrieveProcess(procName);
-                if (proc) {
-                    lock_guard<mutex> lock(queueMutex);
-                    if (GLOBAL_CONFIG.scheduler == "fcfs") {
-                        fcfsQueue.push(proc);
-                    }
-                    else if (GLOBAL_CONFIG.scheduler == "rr") {
-                        rrQueue.push(proc);
-                    }
-                }
-                cv.notify_one();
-                ++processCountName;
-                break;
-            }
-            else {
-                ++processCountName;
-            }
+        string procName = manager.nextBatchName();
+        if (manager.createProcess(procName)) {
+            enqueueProcess(manager.retrieveProcess(procName));
+            cv.notify_one();
         }
     }
 }
 
+void printSystemConfig(const SystemConfig& config) {
+    cout << "\n System configuration loaded successfully:\n";
+    cout << "--------------------------------------------\n";
+    cout << "- num-cpu:            " << config.numCPU << "\n";
+    cout << "- scheduler:          " << config.scheduler << "\n";
+    cout << "- quantum-cycles:     " << config.quantumCycles << "\n";
+    cout << "- batch-process-freq: " << config.batchProcessFreq << "\n";
+    cout << "- min-ins:            " << config.minInstructions << "\n";
+    cout << "- max-ins:            " << config.maxInstructions << "\n";
+    cout << "- delay-per-exec:     " << config.delayPerExec << "\n";
+    cout << "- log-entries:        " << config.logEntries << (config.logSpill ? " (spill on)" : "") << "\n";
+    cout << "- lockstep:           " << (config.lockstep ? "on" : "off");
+    if (config.lockstep) cout << " (ticks of at least " << config.lockstepTickUs << "us)";
+    cout << "\n";
+    cout << "--------------------------------------------\n";
+}
+
+// Live counterpart of initialize. Tunables are picked up by workers and the batch thread on
+// their next instruction/batch; shrinking num-cpu parks the highest cores (their in-flight
+// process is requeued), growing it wakes parked cores and only spawns threads beyond that.
+void reconfigureSystem(const SystemConfig& next, vector<thread>& cpuThreads) {
+    {
+        lock_guard<mutex> lock(configMutex);
+        GLOBAL_CONFIG = next;
+        ++configVersion;
+    }
+    {
+        lock_guard<mutex> lock(queueMutex);
+        activeCPUs = next.numCPU;
+        migrateQueuedWork(next.scheduler);
+        ++idleWake;
+    }
+    tickBarrier.setPeriod(next.lockstepTickUs);
+    for (int i = static_cast<int>(cpuThreads.size()); i < next.numCPU; ++i) {
+        cpuThreads.emplace_back(cpuWorker, i + 1);
+    }
+    parkCv.notify_all();
+    cv.notify_all();
+    idleCv.notify_all();
+}
+
 
 int main() {
     ProcessManager manager;
@@ -639,24 +1783,24 @@ int main() {
         getline(cin, command);
 
         if (command == "initialize") {
-            if (loadSystemConfig()) {
-                cout << "\n System configuration loaded successfully:\n";
-                cout << "--------------------------------------------\n";
-                cout << "- num-cpu:            " << GLOBAL_CONFIG.numCPU << "\n";
-                cout << "- scheduler:          " << GLOBAL_CONFIG.scheduler << "\n";
-                cout << "- quantum-cycles:     " << GLOBAL_CONFIG.quantumCycles << "\n";
-                cout << "- batch-process-freq: " << GLOBAL_CONFIG.batchProcessFreq << "\n";
-                cout << "- min-ins:            " << GLOBAL_CONFIG.minInstructions << "\n";
-                cout << "- max-ins:            " << GLOBAL_CONFIG.maxInstructions << "\n";
-                cout << "- delay-per-exec:     " << GLOBAL_CONFIG.delayPerExec << "\n";
-                cout << "--------------------------------------------\n";
+            SystemConfig loaded;
+            if (loadSystemConfig(loaded)) {
+                printSystemConfig(loaded);
 
                 // Stop old threads if already initialized
                 if (confirmInitialize) {
                     cout << "Reinitializing system...\n";
+                    // The batch thread is stopped for good here and restarted below, so it never
+                    // sees the flags half-way through and never outlives the mode it was started in
+                    if (schedulerRunning) {
+                        stopProcessCreation = true;
+                        if (scheduler_start_thread.joinable()) scheduler_start_thread.join();
+                    }
                     stopScheduler = true;
                     stopProcessCreation = true;
                     cv.notify_all();
+                    parkCv.notify_all();
+                    tickBarrier.stop();
                     for (auto& t : cpuThreads) {
                         if (t.joinable()) t.join();
                     }
@@ -665,10 +1809,28 @@ int main() {
                     stopProcessCreation = false;
                 }
 
+                {
+                    lock_guard<mutex> lock(configMutex);
+                    GLOBAL_CONFIG = loaded;
+                    ++configVersion;
+                }
+                {
+                    // Anything left queued from the previous run follows the new scheduler
+                    lock_guard<mutex> lock(queueMutex);
+                    activeCPUs = loaded.numCPU;
+                    migrateQueuedWork(loaded.scheduler);
+                }
+
                 // Start new CPU threads based on updated config
-                for (int i = 0; i < GLOBAL_CONFIG.numCPU; ++i) {
+                tickBarrier.reset(loaded.numCPU);
+                tickBarrier.setPeriod(loaded.lockstepTickUs);
+                for (int i = 0; i < loaded.numCPU; ++i) {
                     cpuThreads.emplace_back(cpuWorker, i + 1);
                 }
+                if (schedulerRunning) {
+                    stopProcessCreation = false;
+                    scheduler_start_thread = thread(scheduler_start, ref(manager));
+                }
 
                 confirmInitialize = true;
                 cout << "System config loaded and CPU threads restarted.\n";
@@ -678,6 +1840,29 @@ int main() {
                 cout << " Failed to load system configuration.\n";
             }
         }
+        else if (command == "reconfigure") {
+            // Applies config.txt to the running system: workers are parked or added, never joined
+            if (!confirmInitialize) {
+                cout << "Please initialize first.\n";
+                continue;
+            }
+            SystemConfig loaded;
+            if (loadSystemConfig(loaded)) {
+                if (loaded.lockstep != configSnapshot().lockstep) {
+                    // Workers pick their run loop when started; switching modes needs initialize
+                    cout << "lockstep can only change on initialize; keeping it "
+                        << (loaded.lockstep ? "off" : "on") << ".\n";
+                    loaded.lockstep = !loaded.lockstep;
+                }
+                printSystemConfig(loaded);
+                reconfigureSystem(loaded, cpuThreads);
+                cout << "System reconfigured live (" << cpuThreads.size() << " CPU threads, "
+                    << loaded.numCPU << " active).\n";
+            }
+            else {
+                cout << " Failed to load system configuration. Keeping current settings.\n";
+            }
+        }
         else if (command.rfind("screen", 0) == 0) {
             if (confirmInitialize) {
                 handleScreenCommand(command, manager);
@@ -758,7 +1943,10 @@ int main() {
     stopScheduler = true;
     stopProcessCreation = true;
     cv.notify_all();
+    parkCv.notify_all();
+    tickBarrier.stop();
     for (auto& t : cpuThreads) t.join();
+    manager.flushLogs();
 
     return 0;
 }